@@ -18,6 +18,22 @@ if [[ $ARG == "static" ]]; then
     exit 0
 fi
 
+if [[ $ARG == "bench" ]]; then
+    for VARIANT in "" "-DVARIANT_DIAGONAL" "-DVARIANT_KILLER" "-DVARIANT_ANTI_KNIGHT"; do
+        cc -Wall -Wextra -O2 $VARIANT -o sudoku-bench ./sudoku.c -lncurses
+        ./sudoku-bench -bench
+    done
+    rm sudoku-bench
+    exit 0
+fi
+
+if [[ $ARG == "profile" ]]; then
+    cc -Wall -Wextra -O2 -o sudoku-profile ./sudoku.c -lncurses
+    ./sudoku-profile -replay ./profile.keys
+    rm sudoku-profile
+    exit 0
+fi
+
 cc -Wall -Wextra -ggdb -o $PROGRAM ./sudoku.c -lncurses
 
 if [[ $ARG == "run" ]]; then
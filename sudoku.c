@@ -1,14 +1,48 @@
 #include <assert.h>
 #include <curses.h>
+#include <fcntl.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <time.h>
 #include <string.h>
+#include <unistd.h>
 
 #define VERSION "0.9.0"
 #define ONE_KB 1024
 #define N 9
 
+// Digit sets are kept as bitmasks, bit d set meaning digit d (1-9)
+#define ALL_DIGITS   0x3FE
+#define DIGIT_BIT(d) ((uint16_t)(1u << (d)))
+
+// Variant rules are chosen at compile time, e.g. `cc -DVARIANT_DIAGONAL ...`
+// and can be combined. Without any, only the classic checks are compiled in.
+// - VARIANT_DIAGONAL:    both main diagonals hold 1-9 once (X-Sudoku)
+// - VARIANT_KILLER:      cages of cells add up to their sum without repeats
+// - VARIANT_ANTI_KNIGHT: equal digits can not be a chess knight's move apart
+#if VARIANT_DIAGONAL
+#define SUFFIX_DIAGONAL "-diagonal"
+#else
+#define VARIANT_DIAGONAL 0
+#define SUFFIX_DIAGONAL ""
+#endif
+#if VARIANT_KILLER
+#define SUFFIX_KILLER "-killer"
+#else
+#define VARIANT_KILLER 0
+#define SUFFIX_KILLER ""
+#endif
+#if VARIANT_ANTI_KNIGHT
+#define SUFFIX_ANTI_KNIGHT "-antiknight"
+#else
+#define VARIANT_ANTI_KNIGHT 0
+#define SUFFIX_ANTI_KNIGHT ""
+#endif
+
+// Appended to the save and score file names, so each variant keeps its own
+#define VARIANT_SUFFIX SUFFIX_DIAGONAL SUFFIX_KILLER SUFFIX_ANTI_KNIGHT
+
 #define UNUSED(v) (void)(v)
 #define SHIFT(xs, xs_size) (assert((xs_size) > 0), (xs_size)--, *(xs)++)
 
@@ -60,6 +94,8 @@ typedef enum {
 size_t GRID_Y = N * 2 + 3;
 size_t GRID_X = N * 4 + 3;
 
+const char *INIT_TEXT = "Press the <ENTER> key to start...";
+
 struct timespec time_begin = {0};
 struct timespec time_end   = {0};
 
@@ -84,6 +120,157 @@ void shuffle_numbers(size_t *array, size_t size)
     }
 }
 
+#if VARIANT_KILLER
+#define MAX_CAGE_SIZE 4
+#define MAX_CAGE_SUM  45
+
+typedef struct {
+    size_t sum;
+    size_t size;
+    size_t rows[MAX_CAGE_SIZE];
+    size_t cols[MAX_CAGE_SIZE];
+} Cage;
+
+Cage   cages[N * N];
+size_t cage_count;
+size_t cage_of[N][N]; // 1-based index into cages, 0 when the cell has no cage yet
+
+// sum_masks[k][s]: digits that appear in some set of k distinct digits adding up to s
+uint16_t sum_masks[N + 1][MAX_CAGE_SUM + 1];
+
+void init_sum_masks(void)
+{
+    static bool ready = false;
+    if (ready) {
+        return;
+    }
+    for (uint16_t set = 1; set < (1 << N); ++set) {
+        size_t size = 0, sum = 0;
+        for (size_t d = 1; d <= N; ++d) {
+            if (set & (1 << (d - 1))) {
+                ++size;
+                sum += d;
+            }
+        }
+        sum_masks[size][sum] |= set << 1;
+    }
+    ready = true;
+}
+
+// Digits the cage of (row, col) still allows there. The sum mask ignores which
+// digits are already used, so this can be wider than exact, never narrower.
+uint16_t cage_mask(size_t grid[N][N], size_t row, size_t col)
+{
+    if (cage_of[row][col] == 0) {
+        return ALL_DIGITS;
+    }
+
+    Cage *cage = &cages[cage_of[row][col] - 1];
+    uint16_t used = 0;
+    size_t sum = 0, empty = 0;
+    for (size_t i = 0; i < cage->size; ++i) {
+        size_t value = grid[cage->rows[i]][cage->cols[i]];
+        if (value == 0) {
+            ++empty;
+        } else {
+            used |= DIGIT_BIT(value);
+            sum  += value;
+        }
+    }
+    if (sum > cage->sum) {
+        return 0;
+    }
+    return sum_masks[empty][cage->sum - sum] & ~used;
+}
+
+void add_to_cage(size_t id, size_t row, size_t col, size_t value)
+{
+    Cage *cage = &cages[id - 1];
+    cage->rows[cage->size] = row;
+    cage->cols[cage->size] = col;
+    cage->sum += value;
+    ++cage->size;
+    cage_of[row][col] = id;
+}
+
+// Grows cages of up to MAX_CAGE_SIZE cells over a solved grid, without repeats
+void build_cages(size_t solved[N][N])
+{
+    const int steps[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+    init_sum_masks();
+    memset(cages, 0, sizeof(cages));
+    memset(cage_of, 0, sizeof(cage_of));
+    cage_count = 0;
+
+    for (size_t row = 0; row < N; ++row) {
+        for (size_t col = 0; col < N; ++col) {
+            if (cage_of[row][col] != 0) {
+                continue;
+            }
+            size_t id = ++cage_count;
+            size_t target = 2 + rand() % (MAX_CAGE_SIZE - 1);
+            add_to_cage(id, row, col, solved[row][col]);
+
+            Cage *cage = &cages[id - 1];
+            uint16_t used = DIGIT_BIT(solved[row][col]);
+            for (size_t tries = 0; cage->size < target && tries < 16; ++tries) {
+                size_t from = rand() % cage->size;
+                size_t step = rand() % 4;
+                int r = (int)cage->rows[from] + steps[step][0];
+                int c = (int)cage->cols[from] + steps[step][1];
+                if (r < 0 || r >= N || c < 0 || c >= N || cage_of[r][c] != 0 || (used & DIGIT_BIT(solved[r][c]))) {
+                    continue;
+                }
+                add_to_cage(id, r, c, solved[r][c]);
+                used |= DIGIT_BIT(solved[r][c]);
+            }
+        }
+    }
+}
+
+// Cages are saved as their ids, the sums follow from the solved grid
+void rebuild_cages(size_t solved[N][N])
+{
+    size_t ids[N][N];
+    memcpy(ids, cage_of, sizeof(ids));
+
+    init_sum_masks();
+    memset(cages, 0, sizeof(cages));
+    memset(cage_of, 0, sizeof(cage_of));
+    cage_count = 0;
+
+    for (size_t row = 0; row < N; ++row) {
+        for (size_t col = 0; col < N; ++col) {
+            size_t id = ids[row][col];
+            if (id == 0 || id > N * N || cages[id - 1].size == MAX_CAGE_SIZE) {
+                continue;
+            }
+            add_to_cage(id, row, col, solved[row][col]);
+            cage_count = (id > cage_count) ? id : cage_count;
+        }
+    }
+}
+#endif
+
+#if VARIANT_ANTI_KNIGHT
+const int knight_moves[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1}};
+
+// Digits a knight's move away from (row, col)
+uint16_t knight_mask(size_t grid[N][N], size_t row, size_t col)
+{
+    uint16_t seen = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        int r = (int)row + knight_moves[i][0];
+        int c = (int)col + knight_moves[i][1];
+        if (r >= 0 && r < N && c >= 0 && c < N && grid[r][c] != 0) {
+            seen |= DIGIT_BIT(grid[r][c]);
+        }
+    }
+    return seen;
+}
+#endif
+
 int is_safe(size_t grid[N][N], size_t row, size_t col, size_t num)
 {
     for (size_t i = 0; i < N; ++i) {
@@ -101,15 +288,59 @@ int is_safe(size_t grid[N][N], size_t row, size_t col, size_t num)
             }
         }
     }
+
+#if VARIANT_DIAGONAL
+    for (size_t i = 0; i < N; ++i) {
+        if ((row == col && grid[i][i] == num) || (row + col == N - 1 && grid[i][N - 1 - i] == num)) {
+            return 0;
+        }
+    }
+#endif
+#if VARIANT_ANTI_KNIGHT
+    if (knight_mask(grid, row, col) & DIGIT_BIT(num)) {
+        return 0;
+    }
+#endif
+#if VARIANT_KILLER
+    if (!(cage_mask(grid, row, col) & DIGIT_BIT(num))) {
+        return 0;
+    }
+#endif
     return 1;
 }
 
 
+#if VARIANT_DIAGONAL || VARIANT_ANTI_KNIGHT
+#define FILL_BUDGET 500
+size_t fill_budget; // Cells fill_grid() may still try before create_puzzle() starts over
+
+size_t place_forced_digits(size_t grid[N][N], size_t *row, size_t *col);
+#endif
+
 int fill_grid(size_t grid[N][N])
 {
-    size_t row, col;
+    size_t row = 0, col = 0;
     size_t is_empty = 1;
 
+#if VARIANT_DIAGONAL || VARIANT_ANTI_KNIGHT
+    // Going cell by cell gets stuck for a long time on the diagonals and
+    // knight moves, so place every forced digit and branch on the most
+    // constrained cell, and give up on grids that still take too long; a
+    // fresh start is cheaper
+    if (fill_budget == 0) {
+        return 0;
+    }
+    --fill_budget;
+
+    size_t before[N][N];
+    memcpy(before, grid, sizeof(before));
+    size_t fewest = place_forced_digits(grid, &row, &col);
+    if (fewest == 0) {
+        memcpy(grid, before, sizeof(before));
+        return 0;
+    }
+    is_empty = (fewest > N);
+#else
     for (row = 0; row < N; ++row) {
         for (col = 0; col < N; ++col) {
             if (grid[row][col] == 0) {
@@ -121,6 +352,7 @@ int fill_grid(size_t grid[N][N])
             break;
         }
     }
+#endif
 
     if (is_empty) { // is solved
         return 1;
@@ -144,9 +376,35 @@ int fill_grid(size_t grid[N][N])
         }
     }
 
+#if VARIANT_DIAGONAL || VARIANT_ANTI_KNIGHT
+    memcpy(grid, before, sizeof(before));
+#endif
     return 0;
 }
 
+// Unlike fill_grid(), tries digits in order so the work done is repeatable
+int solve_grid(size_t grid[N][N])
+{
+    for (size_t row = 0; row < N; ++row) {
+        for (size_t col = 0; col < N; ++col) {
+            if (grid[row][col] != 0) {
+                continue;
+            }
+            for (size_t num = 1; num <= N; ++num) {
+                if (is_safe(grid, row, col, num)) {
+                    grid[row][col] = num;
+                    if (solve_grid(grid)) {
+                        return 1;
+                    }
+                    grid[row][col] = 0;
+                }
+            }
+            return 0;
+        }
+    }
+    return 1;
+}
+
 void remove_numbers(size_t grid[N][N], size_t difficulty)
 {
     while (difficulty-- != 0) {
@@ -160,8 +418,21 @@ void remove_numbers(size_t grid[N][N], size_t difficulty)
 
 void create_puzzle(size_t grid_puzzle[N][N], size_t grid_solved[N][N], size_t difficulty)
 {
+#if VARIANT_KILLER
+    memset(cage_of, 0, sizeof(cage_of)); // No cages to respect while filling
+#endif
+#if VARIANT_DIAGONAL || VARIANT_ANTI_KNIGHT
+    do {
+        memset(grid_puzzle, 0, sizeof(size_t) * N * N);
+        fill_budget = FILL_BUDGET;
+    } while (!fill_grid(grid_puzzle));
+#else
     fill_grid(grid_puzzle);
+#endif
     memcpy(grid_solved, grid_puzzle, sizeof(&grid_puzzle)*N*N);
+#if VARIANT_KILLER
+    build_cages(grid_solved);
+#endif
     remove_numbers(grid_puzzle, difficulty);
 }
 
@@ -175,9 +446,478 @@ void print_grid_stdout(size_t grid[N][N])
     }
 }
 
+// The row/col/box masks hold the digits already placed in each unit and are
+// updated on every placement, so the candidates of a cell are a few ANDs away.
+#define COUNT_UNITS  (N * 3 + (VARIANT_DIAGONAL ? 2 : 0))
+
+typedef struct {
+    uint16_t rows[N];
+    uint16_t cols[N];
+    uint16_t boxes[N];
+#if VARIANT_DIAGONAL
+    uint16_t diagonals[2];
+#endif
+    uint16_t removed[N][N]; // Eliminated by hints, on top of the unit masks
+    uint16_t notes[N][N];   // Pencil marks entered by the player
+} Candidates;
+
+size_t box_index(size_t row, size_t col)
+{
+    return (row / 3) * 3 + col / 3;
+}
+
+size_t mask_count(uint16_t mask)
+{
+    size_t count = 0;
+    for (; mask != 0; mask &= mask - 1) {
+        ++count;
+    }
+    return count;
+}
+
+size_t mask_first(uint16_t mask)
+{
+    for (size_t d = 1; d <= N; ++d) {
+        if (mask & DIGIT_BIT(d)) {
+            return d;
+        }
+    }
+    return 0;
+}
+
+void candidates_place(Candidates *cand, size_t row, size_t col, size_t num)
+{
+    cand->rows[row]                 |= DIGIT_BIT(num);
+    cand->cols[col]                 |= DIGIT_BIT(num);
+    cand->boxes[box_index(row, col)] |= DIGIT_BIT(num);
+#if VARIANT_DIAGONAL
+    if (row == col)         cand->diagonals[0] |= DIGIT_BIT(num);
+    if (row + col == N - 1) cand->diagonals[1] |= DIGIT_BIT(num);
+#endif
+}
+
+// A digit appears once per unit, so clearing its bits undoes candidates_place()
+void candidates_unplace(Candidates *cand, size_t row, size_t col, size_t num)
+{
+    cand->rows[row]                 &= ~DIGIT_BIT(num);
+    cand->cols[col]                 &= ~DIGIT_BIT(num);
+    cand->boxes[box_index(row, col)] &= ~DIGIT_BIT(num);
+#if VARIANT_DIAGONAL
+    if (row == col)         cand->diagonals[0] &= ~DIGIT_BIT(num);
+    if (row + col == N - 1) cand->diagonals[1] &= ~DIGIT_BIT(num);
+#endif
+}
+
+void candidates_init(Candidates *cand, size_t grid[N][N])
+{
+    memset(cand, 0, sizeof(*cand));
+    for (size_t row = 0; row < N; ++row) {
+        for (size_t col = 0; col < N; ++col) {
+            if (grid[row][col] != 0) {
+                candidates_place(cand, row, col, grid[row][col]);
+            }
+        }
+    }
+}
+
+uint16_t candidates_at(Candidates *cand, size_t grid[N][N], size_t row, size_t col)
+{
+    if (grid[row][col] != 0) {
+        return 0;
+    }
+    uint16_t used = cand->rows[row] | cand->cols[col] | cand->boxes[box_index(row, col)];
+#if VARIANT_DIAGONAL
+    if (row == col)         used |= cand->diagonals[0];
+    if (row + col == N - 1) used |= cand->diagonals[1];
+#endif
+#if VARIANT_ANTI_KNIGHT
+    used |= knight_mask(grid, row, col);
+#endif
+    uint16_t mask = ALL_DIGITS & ~used & ~cand->removed[row][col];
+#if VARIANT_KILLER
+    mask &= cage_mask(grid, row, col);
+#endif
+    return mask;
+}
+
+// Notes are never cleared by placements. The unit masks hide any note that a
+// placed digit rules out, and bring it back once the placement is undone.
+uint16_t notes_at(Candidates *cand, size_t grid[N][N], size_t row, size_t col)
+{
+    return cand->notes[row][col] & candidates_at(cand, grid, row, col);
+}
+
+// Fits notes in the 3 columns inside a cell, e.g. "15 " or "12+" when there are more
+void format_notes(uint16_t mask, char *buffer)
+{
+    size_t count = mask_count(mask);
+    size_t i = 0;
+    for (size_t d = 1; d <= N && i < 3; ++d) {
+        if (mask & DIGIT_BIT(d)) {
+            buffer[i] = (count > 3 && i == 2) ? '+' : '0' + d;
+            ++i;
+        }
+    }
+    while (i < 3) {
+        buffer[i++] = ' ';
+    }
+    buffer[3] = '\0';
+}
+
+// Units 0-8 are rows, 9-17 are columns, 18-26 are boxes, then the diagonals
+void unit_cell(size_t unit, size_t i, size_t *row, size_t *col)
+{
+    if (unit < N) {
+        *row = unit;
+        *col = i;
+    } else if (unit < N * 2) {
+        *row = i;
+        *col = unit - N;
+    } else if (unit < N * 3) {
+        size_t box = unit - N * 2;
+        *row = (box / 3) * 3 + i / 3;
+        *col = (box % 3) * 3 + i % 3;
+    } else {
+        *row = i;
+        *col = (unit == N * 3) ? i : N - 1 - i;
+    }
+}
+
+const char *unit_name(size_t unit)
+{
+    if (unit < N)     return "row";
+    if (unit < N * 2) return "col";
+    if (unit < N * 3) return "box";
+    return "diag";
+}
+
+// Ordered from cheapest to most expensive to find
+typedef enum {
+    HINT_NONE,
+    HINT_NAKED_SINGLE,
+    HINT_HIDDEN_SINGLE,
+    HINT_POINTING,
+    HINT_NAKED_PAIR,
+} Hint_Technique;
+
+typedef struct {
+    Hint_Technique technique;
+    size_t   digit;            // Digit to place, or the digit eliminated when pointing
+    uint16_t digits;           // Naked pair digits
+    size_t   row;              // Cell to place into for singles
+    size_t   col;
+    size_t   unit;             // Unit the deduction was made in
+    size_t   target_unit;      // Row or column the pointing digit is eliminated from
+    bool     involved[N][N];   // Cells that justify the deduction
+    uint16_t eliminate[N][N];  // Candidates removed by the deduction
+} Hint;
+
+bool find_naked_single(Candidates *cand, size_t grid[N][N], Hint *hint)
+{
+    for (size_t row = 0; row < N; ++row) {
+        for (size_t col = 0; col < N; ++col) {
+            uint16_t mask = candidates_at(cand, grid, row, col);
+            if (mask_count(mask) == 1) {
+                hint->technique = HINT_NAKED_SINGLE;
+                hint->digit     = mask_first(mask);
+                hint->row       = row;
+                hint->col       = col;
+                hint->unit      = row;
+                hint->involved[row][col] = true;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool find_hidden_single(Candidates *cand, size_t grid[N][N], Hint *hint)
+{
+    for (size_t unit = 0; unit < COUNT_UNITS; ++unit) {
+        // Digits seen once and digits seen more than once in this unit
+        uint16_t once = 0, many = 0;
+        for (size_t i = 0; i < N; ++i) {
+            size_t row, col;
+            unit_cell(unit, i, &row, &col);
+            uint16_t mask = candidates_at(cand, grid, row, col);
+            many |= once & mask;
+            once |= mask;
+        }
+        uint16_t single = once & ~many;
+        if (single == 0) {
+            continue;
+        }
+
+        size_t digit = mask_first(single);
+        for (size_t i = 0; i < N; ++i) {
+            size_t row, col;
+            unit_cell(unit, i, &row, &col);
+            hint->involved[row][col] = true;
+            if (candidates_at(cand, grid, row, col) & DIGIT_BIT(digit)) {
+                hint->row = row;
+                hint->col = col;
+            }
+        }
+        hint->technique = HINT_HIDDEN_SINGLE;
+        hint->digit     = digit;
+        hint->unit      = unit;
+        return true;
+    }
+    return false;
+}
+
+// A digit confined to one row or column of a box cannot appear in the rest of that line
+bool find_pointing(Candidates *cand, size_t grid[N][N], Hint *hint)
+{
+    for (size_t box = 0; box < N; ++box) {
+        size_t unit = N * 2 + box;
+        for (size_t digit = 1; digit <= N; ++digit) {
+            // Row and column shared by every candidate cell, N once they differ
+            size_t line_row = N, line_col = N;
+            size_t count = 0;
+            for (size_t i = 0; i < N; ++i) {
+                size_t row, col;
+                unit_cell(unit, i, &row, &col);
+                if (candidates_at(cand, grid, row, col) & DIGIT_BIT(digit)) {
+                    line_row = (count == 0 || line_row == row) ? row : N;
+                    line_col = (count == 0 || line_col == col) ? col : N;
+                    ++count;
+                }
+            }
+
+            size_t target_unit;
+            if (count < 2) {
+                continue; // A lone candidate is a hidden single
+            } else if (line_row != N) {
+                target_unit = line_row;
+            } else if (line_col != N) {
+                target_unit = N + line_col;
+            } else {
+                continue;
+            }
+
+            bool found = false;
+            for (size_t i = 0; i < N; ++i) {
+                size_t row, col;
+                unit_cell(target_unit, i, &row, &col);
+                if (box_index(row, col) != box && (candidates_at(cand, grid, row, col) & DIGIT_BIT(digit))) {
+                    hint->eliminate[row][col] |= DIGIT_BIT(digit);
+                    found = true;
+                }
+            }
+            if (!found) {
+                continue;
+            }
+
+            for (size_t i = 0; i < N; ++i) {
+                size_t row, col;
+                unit_cell(unit, i, &row, &col);
+                if (candidates_at(cand, grid, row, col) & DIGIT_BIT(digit)) {
+                    hint->involved[row][col] = true;
+                }
+            }
+            hint->technique   = HINT_POINTING;
+            hint->digit       = digit;
+            hint->unit        = unit;
+            hint->target_unit = target_unit;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Two cells of a unit sharing the same two candidates own those digits in the unit
+bool find_naked_pair(Candidates *cand, size_t grid[N][N], Hint *hint)
+{
+    for (size_t unit = 0; unit < COUNT_UNITS; ++unit) {
+        uint16_t masks[N];
+        for (size_t i = 0; i < N; ++i) {
+            size_t row, col;
+            unit_cell(unit, i, &row, &col);
+            masks[i] = candidates_at(cand, grid, row, col);
+        }
+
+        for (size_t a = 0; a < N; ++a) {
+            if (mask_count(masks[a]) != 2) {
+                continue;
+            }
+            for (size_t b = a + 1; b < N; ++b) {
+                if (masks[b] != masks[a]) {
+                    continue;
+                }
+
+                bool found = false;
+                for (size_t i = 0; i < N; ++i) {
+                    if (i == a || i == b || (masks[i] & masks[a]) == 0) {
+                        continue;
+                    }
+                    size_t row, col;
+                    unit_cell(unit, i, &row, &col);
+                    hint->eliminate[row][col] = masks[i] & masks[a];
+                    found = true;
+                }
+                if (!found) {
+                    continue;
+                }
+
+                size_t row, col;
+                unit_cell(unit, a, &row, &col);
+                hint->involved[row][col] = true;
+                unit_cell(unit, b, &row, &col);
+                hint->involved[row][col] = true;
+                hint->technique = HINT_NAKED_PAIR;
+                hint->digits    = masks[a];
+                hint->unit      = unit;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Finds the cheapest logical deduction available anywhere on the board.
+// Returns false if none of the known techniques apply.
+bool find_hint(Candidates *cand, size_t grid[N][N], Hint *hint)
+{
+    memset(hint, 0, sizeof(*hint));
+    return find_naked_single(cand, grid, hint) ||
+           find_hidden_single(cand, grid, hint) ||
+           find_pointing(cand, grid, hint) ||
+           find_naked_pair(cand, grid, hint);
+}
+
+// Eliminations are remembered so the next hint builds on this one
+void apply_hint(Candidates *cand, Hint *hint)
+{
+    for (size_t row = 0; row < N; ++row) {
+        for (size_t col = 0; col < N; ++col) {
+            cand->removed[row][col] |= hint->eliminate[row][col];
+        }
+    }
+}
+
+void describe_hint(Hint *hint, char *buffer, size_t size)
+{
+    switch (hint->technique) {
+    case HINT_NAKED_SINGLE:
+        snprintf(buffer, size, "Naked single: %zu at r%zuc%zu", hint->digit, hint->row + 1, hint->col + 1);
+        break;
+    case HINT_HIDDEN_SINGLE:
+        snprintf(buffer, size, "Hidden single: %zu in %s %zu", hint->digit, unit_name(hint->unit), hint->unit % N + 1);
+        break;
+    case HINT_POINTING:
+        snprintf(buffer, size, "Pointing %zu: box %zu -> %s %zu", hint->digit, hint->unit % N + 1,
+                 unit_name(hint->target_unit), hint->target_unit % N + 1);
+        break;
+    case HINT_NAKED_PAIR:
+        snprintf(buffer, size, "Naked pair %zu%zu in %s %zu", mask_first(hint->digits),
+                 mask_first(hint->digits & (hint->digits - 1)), unit_name(hint->unit), hint->unit % N + 1);
+        break;
+    default:
+        snprintf(buffer, size, "No logical step found");
+        break;
+    }
+}
+
+#if VARIANT_DIAGONAL || VARIANT_ANTI_KNIGHT
+// Places singles until none are left, then finds the empty cell with the
+// fewest candidates. Returns how many it has, N + 1 if the grid is full, or
+// 0 if the grid can not be completed.
+size_t place_forced_digits(size_t grid[N][N], size_t *row, size_t *col)
+{
+    Candidates cand;
+    Hint hint;
+    candidates_init(&cand, grid);
+    while (find_naked_single(&cand, grid, &hint) || find_hidden_single(&cand, grid, &hint)) {
+        grid[hint.row][hint.col] = hint.digit;
+        candidates_place(&cand, hint.row, hint.col, hint.digit);
+    }
+
+    uint16_t masks[N][N];
+    size_t fewest = N + 1;
+    for (size_t r = 0; r < N; ++r) {
+        for (size_t c = 0; c < N; ++c) {
+            masks[r][c] = (grid[r][c] != 0) ? DIGIT_BIT(grid[r][c]) : candidates_at(&cand, grid, r, c);
+            if (grid[r][c] == 0 && mask_count(masks[r][c]) < fewest) {
+                fewest = mask_count(masks[r][c]);
+                *row = r;
+                *col = c;
+            }
+        }
+    }
+
+    // Every unit must still have room for every digit
+    for (size_t unit = 0; unit < COUNT_UNITS && fewest != 0; ++unit) {
+        uint16_t seen = 0;
+        for (size_t i = 0; i < N; ++i) {
+            size_t r, c;
+            unit_cell(unit, i, &r, &c);
+            seen |= masks[r][c];
+        }
+        if (seen != ALL_DIGITS) {
+            fewest = 0;
+        }
+    }
+    return fewest;
+}
+#endif
+
+#define UNDO_CAPACITY 256
+
+typedef enum {
+    MOVE_PLACE,
+    MOVE_NOTE,
+} Move_Kind;
+
+typedef struct {
+    Move_Kind kind;
+    size_t    row;
+    size_t    col;
+    size_t    digit;
+} Move;
+
+// Ring buffer, the oldest moves are dropped once it is full
+typedef struct {
+    Move   moves[UNDO_CAPACITY];
+    size_t head;
+    size_t count;
+} Undo_History;
+
+void push_move(Undo_History *history, Move_Kind kind, size_t row, size_t col, size_t digit)
+{
+    history->moves[history->head] = (Move){ .kind = kind, .row = row, .col = col, .digit = digit };
+    history->head = (history->head + 1) % UNDO_CAPACITY;
+    if (history->count < UNDO_CAPACITY) {
+        ++history->count;
+    }
+}
+
+bool undo_move(Undo_History *history, Candidates *cand, size_t grid[N][N])
+{
+    if (history->count == 0) {
+        return false;
+    }
+    history->head = (history->head + UNDO_CAPACITY - 1) % UNDO_CAPACITY;
+    --history->count;
+
+    Move *move = &history->moves[history->head];
+    switch (move->kind) {
+    case MOVE_PLACE:
+        grid[move->row][move->col] = 0;
+        candidates_unplace(cand, move->row, move->col, move->digit);
+        break;
+    case MOVE_NOTE:
+        cand->notes[move->row][move->col] ^= DIGIT_BIT(move->digit);
+        break;
+    }
+    return true;
+}
+
+// Only builds the path. The file is read when the puzzle is loaded, after the
+// first frame, and created the first time a puzzle is saved.
 int setup_save_data_file(char *path_puzzle_data_file)
 {
-    const char *puzzle_data_file = "save-data.sudoku";
+    const char *puzzle_data_file = "save-data" VARIANT_SUFFIX ".sudoku";
     const char *xdg_cache_home = getenv("XDG_CACHE_HOME");
     if (xdg_cache_home == NULL) {
         const char *home_dir = getenv("HOME");
@@ -189,21 +929,6 @@ int setup_save_data_file(char *path_puzzle_data_file)
     } else {
         sprintf(path_puzzle_data_file, "%s/%s", xdg_cache_home, puzzle_data_file);
     }
-
-    FILE *f = fopen(path_puzzle_data_file, "r+");
-    if (f) {
-        fclose(f);
-        return 0;
-    }
-    if (!f) {
-        f = fopen(path_puzzle_data_file, "w+");
-        if (!f) {
-            fprintf(stderr, "ERROR: failed to open or create puzzle data file at %s\n", path_puzzle_data_file);
-            fclose(f);
-            return 1;
-        }
-    }
-    fclose(f);
     return 0;
 }
 
@@ -214,37 +939,50 @@ typedef struct {
     // TODO: Cursor History
 } Save_Data;
 
-void load_last_puzzle(Save_Data *sada, Difficulty *difficulty, size_t puzzle[N][N], size_t solved[N][N])
+// Returns 0 if a whole puzzle was read. A missing file just means there is
+// nothing saved yet.
+int load_last_puzzle(Save_Data *sada, Difficulty *difficulty, size_t puzzle[N][N], size_t solved[N][N])
 {
     FILE *f = fopen(sada->path_save_data_file, "r");
     if (f == NULL) {
-        fprintf(stderr, "ERROR: could not open puzzle data file at %s\n", sada->path_save_data_file);
-        return;
+        return 1;
     }
 
+    size_t values_read = 0;
     for (size_t i = 0; i < 3; ++i) {
         switch (i) {
         case 0: // Difficulty
-            fscanf(f, "%u", difficulty);
+            values_read += fscanf(f, "%u", difficulty) == 1;
             break;
         case 1: // Unsolved grid
             for (size_t row = 0; row < N; ++row) {
                 for (size_t col = 0; col < N; ++col) {
-                    fscanf(f, "%zu", &puzzle[row][col]);
+                    values_read += fscanf(f, "%zu", &puzzle[row][col]) == 1;
                 }
             }
             break;
         case 2: // Solved grid
             for (size_t row = 0; row < N; ++row) {
                 for (size_t col = 0; col < N; ++col) {
-                    fscanf(f, "%zu", &solved[row][col]);
+                    values_read += fscanf(f, "%zu", &solved[row][col]) == 1;
                 }
             }
             break;
         }
     }
 
+#if VARIANT_KILLER
+    for (size_t row = 0; row < N; ++row) {
+        for (size_t col = 0; col < N; ++col) {
+            values_read += fscanf(f, "%zu", &cage_of[row][col]) == 1;
+        }
+    }
+    rebuild_cages(solved);
+    values_read -= N * N;
+#endif
+
     fclose(f);
+    return (values_read == 1 + N * N * 2 && *difficulty < COUNT_DIFFICULTY) ? 0 : 1;
 }
 
 void save_puzzle_data(Save_Data *sada, size_t difficulty, size_t grid_puzzle[N][N], size_t grid_solved[N][N])
@@ -253,7 +991,7 @@ void save_puzzle_data(Save_Data *sada, size_t difficulty, size_t grid_puzzle[N][
         return;
     }
 
-    FILE *f = fopen(sada->path_save_data_file, "r+");
+    FILE *f = fopen(sada->path_save_data_file, "w");
     if (f == NULL) {
         fprintf(stderr, "ERROR: could not open puzzle data file at %s\n", sada->path_save_data_file);
         return;
@@ -262,6 +1000,9 @@ void save_puzzle_data(Save_Data *sada, size_t difficulty, size_t grid_puzzle[N][
     fprintf(f, "%zu\n", difficulty);
     SAVE_DATA_F(f, grid_puzzle);
     SAVE_DATA_F(f, grid_solved);
+#if VARIANT_KILLER
+    SAVE_DATA_F(f, cage_of);
+#endif
 
     fclose(f);
 }
@@ -269,9 +1010,12 @@ void save_puzzle_data(Save_Data *sada, size_t difficulty, size_t grid_puzzle[N][
 // References:
 // - https://wiki.archlinux.org/title/XDG_Base_Directory
 // - https://specifications.freedesktop.org/basedir-spec/latest/
+//
+// Like setup_save_data_file(), only builds the path. Scores are read when they
+// are first needed and the file is created with the first best time.
 int setup_score_file(char *path_score_file)
 {
-    const char *score_file = "scores.sudoku";
+    const char *score_file = "scores" VARIANT_SUFFIX ".sudoku";
 
     const char *xdg_data_home = getenv("XDG_DATA_HOME");
     if (xdg_data_home == NULL) {
@@ -284,27 +1028,6 @@ int setup_score_file(char *path_score_file)
     } else {
         sprintf(path_score_file, "%s/%s", xdg_data_home, score_file);
     }
-
-    FILE *f = fopen(path_score_file, "r+");
-    if (f) {      // score_file exists
-        fclose(f);
-        return 0;
-    }
-
-    if (!f) {
-        f = fopen(path_score_file, "w+");
-        if (!f) {
-            fprintf(stderr, "ERROR: failed to open or create score file at %s\n", path_score_file);
-            fclose(f);
-            return 1;
-        }
-    }
-
-    for (size_t i = 0; i < COUNT_DIFFICULTY; ++i) {
-        fprintf(f, "0.000000 ");
-    }
-
-    fclose(f);
     return 0;
 }
 
@@ -315,19 +1038,52 @@ typedef struct {
     Difficulty current_difficulty;
     double     current_score;
     double     best_scores[COUNT_DIFFICULTY];
+    bool       scores_loaded;
     bool       hint_used;
 } Score_Data;
 
+// Without a score file, every best time stays at 0.0 (none yet)
+void grab_scores(Score_Data *sd)
+{
+    if (sd->scores_loaded) {
+        return;
+    }
+    sd->scores_loaded = true;
+
+    char line[ONE_KB];
+    char *sep = " ";
+    FILE *f = fopen(sd->path_score_file, "r");
+    if (f == NULL) {
+        return;
+    }
+    char *read = fgets(line, sizeof(line), f);
+    fclose(f);
+    if (read == NULL) {
+        return;
+    }
+
+    char *token = strtok(line, sep);
+    for (size_t i = 0; i < COUNT_DIFFICULTY && token != NULL; ++i) {
+        sd->best_scores[i] = atof(token);
+        token = strtok(NULL, sep);
+    }
+}
+
 void save_score(Score_Data *sd)
 {
-    if (!sd->save_scores || sd->hint_used ||
-        (sd->best_scores[sd->current_difficulty] != 0.0 &&
-         sd->current_score > sd->best_scores[sd->current_difficulty])) {
+    if (!sd->save_scores || sd->hint_used) {
+        return;
+    }
+    grab_scores(sd);
+    if (sd->best_scores[sd->current_difficulty] != 0.0 &&
+        sd->current_score > sd->best_scores[sd->current_difficulty]) {
         return;
     }
 
-    FILE *f = fopen(sd->path_score_file, "r+");
-    assert(f != NULL);
+    FILE *f = fopen(sd->path_score_file, "w");
+    if (f == NULL) {
+        return;
+    }
 
     if (sd->best_scores[sd->current_difficulty] == 0.0) {
         sd->best_scores[sd->current_difficulty] = sd->current_score;
@@ -349,20 +1105,29 @@ void save_score(Score_Data *sd)
     fclose(f);
 }
 
-void grab_scores(Score_Data *sd)
+// Everything done before the first frame, so no file is touched here
+void setup_files(Score_Data *sd, Save_Data *sada)
 {
-    char line[ONE_KB];
-    char *sep = " ";
-    FILE *f = fopen(sd->path_score_file, "r");
-    assert(f != NULL);
-    assert(fgets(line, sizeof(line), f) != NULL);
-    fclose(f);
+    if (setup_score_file(sd->path_score_file) == 0) {
+        sd->save_scores = true;
+    }
+    if (setup_save_data_file(sada->path_save_data_file) == 0) {
+        sada->save_data = true;
+    }
+}
 
-    char *token = strtok(line, sep);
-    for (size_t i = 0; i < COUNT_DIFFICULTY && token != NULL; ++i) {
-        sd->best_scores[i] = atof(token);
-        token = strtok(NULL, sep);
+// Continues the saved puzzle if there is one, otherwise makes a new one
+void load_or_create_puzzle(Save_Data *sada, Score_Data *sd, size_t difficulty_values[COUNT_DIFFICULTY],
+                           size_t grid_puzzle[N][N], size_t grid_solved[N][N])
+{
+    if (sada->save_data && load_last_puzzle(sada, &sd->current_difficulty, grid_puzzle, grid_solved) == 0) {
+        sd->save_scores = false;
+        return;
     }
+
+    sd->current_difficulty = EASY;
+    memset(grid_puzzle, 0, sizeof(size_t) * N * N);
+    create_puzzle(grid_puzzle, grid_solved, difficulty_values[sd->current_difficulty]);
 }
 
 typedef struct {
@@ -373,9 +1138,12 @@ typedef struct {
     bool   highlight_same_value;
     bool   number_completed;
     bool   puzzle_completed;
+    bool   notes_mode;
+    bool   show_hint;
+    Hint   hint;
 } Window_Info;
 
-void print_grid_window(WINDOW *win, size_t grid[N][N])
+void print_grid_window(WINDOW *win, size_t grid[N][N], Candidates *cand)
 {
     for (size_t row = 0; row < N; ++row) {
         for (size_t col = 0; col < N; ++col) {
@@ -399,6 +1167,30 @@ void print_grid_window(WINDOW *win, size_t grid[N][N])
                 (cell_value == 0) ? mvwprintw(win, y + 1, x, "     ") : mvwprintw(win, y + 1, x, "  %zu  ", cell_value);
             }
 
+#if VARIANT_KILLER
+            // A cage's sum sits on the border above its first cell
+            size_t id = cage_of[row][col];
+            if (id != 0 && cages[id - 1].rows[0] == row && cages[id - 1].cols[0] == col) {
+                mvwprintw(win, y, x + 1, "%zu", cages[id - 1].sum);
+            }
+#endif
+
+            uint16_t notes = notes_at(cand, grid, row, col);
+            if (notes != 0) {
+                char text[4];
+                format_notes(notes, text);
+                wattron(win, A_DIM);
+                mvwprintw(win, y + 1, x + 1, "%s", text);
+                wattroff(win, A_DIM);
+            }
+#if VARIANT_DIAGONAL
+            else if (cell_value == 0 && (row == col || row + col == N - 1)) {
+                wattron(win, A_DIM);
+                mvwprintw(win, y + 1, x + 2, ".");
+                wattroff(win, A_DIM);
+            }
+#endif
+
             if (row + 1 == N) {
                 mvwprintw(win, y + 2, x, "=====");
             }
@@ -420,7 +1212,65 @@ void highlight_cells(WINDOW *win, size_t grid[N][N], size_t cell_value)
     }
 }
 
-void draw_grid(Window_Info *winfo, size_t grid[N][N], Score_Data *sd)
+void highlight_hint(WINDOW *win, size_t grid[N][N], Candidates *cand, Hint *hint)
+{
+    wattron(win, A_UNDERLINE);
+    for (size_t row = 0; row < N; ++row) {
+        for (size_t col = 0; col < N; ++col) {
+            if (hint->involved[row][col] && grid[row][col] == 0) {
+                char text[4];
+                format_notes(notes_at(cand, grid, row, col), text);
+                mvwprintw(win, row * 2 + 2, col * 4 + 2, "%s", text);
+            } else if (hint->involved[row][col]) {
+                mvwprintw(win, row * 2 + 2, col * 4 + 2, " %zu ", grid[row][col]);
+            }
+        }
+    }
+    wattroff(win, A_UNDERLINE);
+
+    // Eliminated candidates are shown struck from their cell, e.g. "-5 " or
+    // "-25" when a naked pair removes both of its digits
+    wattron(win, A_BOLD);
+    for (size_t row = 0; row < N; ++row) {
+        for (size_t col = 0; col < N; ++col) {
+            if (hint->eliminate[row][col] != 0) {
+                char text[4];
+                format_notes(hint->eliminate[row][col], text);
+                mvwprintw(win, row * 2 + 2, col * 4 + 2, "-%.2s", text);
+            }
+        }
+    }
+    wattroff(win, A_BOLD);
+}
+
+#if VARIANT_KILLER
+void highlight_cage(WINDOW *win, size_t grid[N][N], Candidates *cand, size_t cursor_row, size_t cursor_col)
+{
+    size_t id = cage_of[cursor_row][cursor_col];
+    if (id == 0) {
+        return;
+    }
+
+    Cage *cage = &cages[id - 1];
+    wattron(win, A_UNDERLINE);
+    for (size_t i = 0; i < cage->size; ++i) {
+        size_t row = cage->rows[i];
+        size_t col = cage->cols[i];
+        if (grid[row][col] == 0) {
+            char text[4];
+            format_notes(notes_at(cand, grid, row, col), text);
+            mvwprintw(win, row * 2 + 2, col * 4 + 2, "%s", text);
+        } else {
+            mvwprintw(win, row * 2 + 2, col * 4 + 2, " %zu ", grid[row][col]);
+        }
+    }
+    wattroff(win, A_UNDERLINE);
+
+    mvwprintw(win, GRID_Y - 1, GRID_X - 10, "cage-[%2zu]", cage->sum);
+}
+#endif
+
+void draw_grid(Window_Info *winfo, size_t grid[N][N], Candidates *cand, Score_Data *sd)
 {
     box(winfo->window, 0, 0);
 
@@ -439,7 +1289,13 @@ void draw_grid(Window_Info *winfo, size_t grid[N][N], Score_Data *sd)
         break;
     }
 
-    print_grid_window(winfo->window, grid);
+    print_grid_window(winfo->window, grid, cand);
+    if (winfo->show_hint) {
+        highlight_hint(winfo->window, grid, cand, &winfo->hint);
+    }
+#if VARIANT_KILLER
+    highlight_cage(winfo->window, grid, cand, winfo->cursor_row, winfo->cursor_col);
+#endif
 
     size_t highlight_y = winfo->cursor_row * 2 + 1;
     size_t highlight_x = winfo->cursor_col * 4 + 1;
@@ -449,7 +1305,9 @@ void draw_grid(Window_Info *winfo, size_t grid[N][N], Score_Data *sd)
     wattron(winfo->window, A_REVERSE); // Reverses background/foreground to "highlight" current cell
 
     if (cell_value == 0) {
-        mvwprintw(winfo->window, highlight_y + 1, highlight_x, "|   |");
+        char text[4];
+        format_notes(notes_at(cand, grid, winfo->cursor_row, winfo->cursor_col), text);
+        mvwprintw(winfo->window, highlight_y + 1, highlight_x, "|%s|", text);
         winfo->number_completed = false;
     }
     else {
@@ -464,6 +1322,19 @@ void draw_grid(Window_Info *winfo, size_t grid[N][N], Score_Data *sd)
 
     wattroff(winfo->window, A_REVERSE);
 
+    // All notes of the current cell, as the cell itself only fits three
+    if (winfo->notes_mode) {
+        uint16_t notes = notes_at(cand, grid, winfo->cursor_row, winfo->cursor_col);
+        wmove(winfo->window, GRID_Y - 1, 0);
+        wprintw(winfo->window, "notes-[");
+        for (size_t d = 1; d <= N; ++d) {
+            if (notes & DIGIT_BIT(d)) {
+                wprintw(winfo->window, " %zu", d);
+            }
+        }
+        wprintw(winfo->window, " ]");
+    }
+
     if (winfo->puzzle_started && winfo->puzzle_completed) {
             mvwprintw(stdscr, ((LINES + GRID_Y) / 2) + 1, (COLS - 17) * 0.5, "Puzzle completed.");
     } else if (winfo->puzzle_started && cell_value != 0) {
@@ -497,7 +1368,14 @@ void draw_grid(Window_Info *winfo, size_t grid[N][N], Score_Data *sd)
         }
     }
 
-    wrefresh(winfo->window);
+}
+
+// Both windows go out in one update, so a frame is a single write to the terminal
+void refresh_frame(WINDOW *win)
+{
+    wnoutrefresh(stdscr);
+    wnoutrefresh(win);
+    doupdate();
 }
 
 void show_controls(void)
@@ -505,7 +1383,9 @@ void show_controls(void)
     const char *controls[] = {"Controls:",
                               "[TAB] Change Difficulty",
                               "[ H ] Highlight Same Value Cells",
-                              "[ ? ] Fill Current Cell",
+                              "[ ? ] Hint Next Step",
+                              "[ N ] Toggle Notes Mode",
+                              "[ U ] Undo",
                               "[ Q ] Quit"};
     size_t controls_count = *(&controls + 1) - controls;
 
@@ -531,18 +1411,475 @@ void clear_info_text(int len_init_text)
     mvwprintw(stdscr, ((LINES + GRID_Y) / 2) + 1, (COLS - len_init_text) * 0.5, "%*c", len_init_text, ' ');
 }
 
+// Stands in for initscr(). Given an output file, a fixed size xterm writes
+// there instead of the real terminal, for replays and the startup benchmark.
+int start_screen(FILE *output, FILE *input, SCREEN **screen)
+{
+    if (output == NULL) {
+        initscr();
+        return 0;
+    }
+
+    setenv("LINES", "24", 1);
+    setenv("COLUMNS", "80", 1);
+    *screen = newterm("xterm", output, input);
+    if (*screen == NULL) {
+        fprintf(stderr, "ERROR: could not start the dummy terminal, is the xterm terminfo entry installed?\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Everything up to the first frame, the start screen with the controls.
+// Returns NULL if the terminal can not be used.
+WINDOW *start_first_frame(FILE *output, FILE *input, SCREEN **screen)
+{
+    if (start_screen(output, input, screen) != 0) {
+        return NULL;
+    }
+    noecho();
+    keypad(stdscr, TRUE);
+    cbreak();
+    curs_set(0);
+
+    if ((LINES < (int)GRID_Y) || (LINES <= (int)((LINES + GRID_Y) / 2) + 1)  || (COLS < (int)GRID_X)) {
+        endwin();
+        fprintf(stderr, "Terminal size too smol ._.\n");
+        fprintf(stderr, "Need minimum: 24 LINES, 39 COLUMNS\n"); // $ echo $LINES $COLUMNS
+        return NULL;
+    }
+
+    WINDOW *sudoku_matrix = newwin(GRID_Y, GRID_X, (LINES - GRID_Y) / 2, (COLS - GRID_X) / 2);
+
+    const int len_init_text = strlen(INIT_TEXT);
+    mvwprintw(stdscr, ((LINES + GRID_Y) / 2) + 1, (COLS - len_init_text) * 0.5, "%s", INIT_TEXT);
+    show_controls();
+    refresh();
+    return sudoku_matrix;
+}
+
+#define BENCH_PUZZLES 200
+
+const char *bench_difficulty_name(size_t difficulty)
+{
+    switch (difficulty) {
+    case EASY:   return "easy";
+    case MEDIUM: return "medium";
+    case HARD:   return "hard";
+    default:     return "?";
+    }
+}
+
+void benchmark_puzzles(size_t difficulty_values[COUNT_DIFFICULTY])
+{
+    for (size_t d = 0; d < COUNT_DIFFICULTY; ++d) {
+        double generate_total = 0.0, generate_worst = 0.0;
+        double solve_total    = 0.0, solve_worst    = 0.0;
+
+        for (size_t p = 0; p < BENCH_PUZZLES; ++p) {
+            size_t grid_puzzle[N][N] = {0};
+            size_t grid_solved[N][N] = {0};
+            struct timespec begin, end;
+
+            clock_gettime(CLOCK_MONOTONIC, &begin);
+            create_puzzle(grid_puzzle, grid_solved, difficulty_values[d]);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            double elapsed = time_taken(begin, end);
+            generate_total += elapsed;
+            generate_worst  = (elapsed > generate_worst) ? elapsed : generate_worst;
+
+            clock_gettime(CLOCK_MONOTONIC, &begin);
+            int solved = solve_grid(grid_puzzle);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            assert(solved);
+            elapsed = time_taken(begin, end);
+            solve_total += elapsed;
+            solve_worst  = (elapsed > solve_worst) ? elapsed : solve_worst;
+        }
+
+        printf("gen   %-6s  %6d runs   avg %8.3f us  max %8.3f us\n", bench_difficulty_name(d),
+               BENCH_PUZZLES, generate_total / BENCH_PUZZLES * 1e6, generate_worst * 1e6);
+        printf("solve %-6s  %6d runs   avg %8.3f us  max %8.3f us\n", bench_difficulty_name(d),
+               BENCH_PUZZLES, solve_total / BENCH_PUZZLES * 1e6, solve_worst * 1e6);
+    }
+}
+
+#define BENCH_STARTUPS 1000
+#define STARTUP_BUDGET 1e-3 // Seconds until the first frame
+
+// The work before the first frame, drawn on a dummy terminal writing to
+// /dev/null, and the deferred load or generation after it
+void benchmark_startup(size_t difficulty_values[COUNT_DIFFICULTY])
+{
+    char path_save_data_file[] = "/tmp/sudoku-bench-XXXXXX";
+    int fd = mkstemp(path_save_data_file);
+    assert(fd != -1);
+    close(fd);
+
+    FILE *output = fopen("/dev/null", "w");
+    FILE *input  = fopen("/dev/null", "r");
+    assert(output != NULL && input != NULL);
+
+    double startup_total = 0.0, startup_worst = 0.0;
+    double load_total    = 0.0, load_worst    = 0.0;
+    double create_total  = 0.0, create_worst  = 0.0;
+
+    for (size_t i = 0; i < BENCH_STARTUPS; ++i) {
+        Score_Data sd = { .current_difficulty = EASY };
+        Save_Data  pd = { .save_data = false };
+        size_t grid_puzzle[N][N] = {0};
+        size_t grid_solved[N][N] = {0};
+        struct timespec begin, end;
+
+        SCREEN *screen = NULL;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        setup_files(&sd, &pd);
+        WINDOW *sudoku_matrix = start_first_frame(output, input, &screen);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (sudoku_matrix == NULL) {
+            break;
+        }
+        delwin(sudoku_matrix);
+        endwin();
+        delscreen(screen);
+        double elapsed = time_taken(begin, end);
+        startup_total += elapsed;
+        startup_worst  = (elapsed > startup_worst) ? elapsed : startup_worst;
+
+        // Nothing saved yet
+        pd.save_data = false;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        load_or_create_puzzle(&pd, &sd, difficulty_values, grid_puzzle, grid_solved);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        elapsed = time_taken(begin, end);
+        create_total += elapsed;
+        create_worst  = (elapsed > create_worst) ? elapsed : create_worst;
+
+        // Continuing that puzzle, from a save file of our own
+        pd.save_data = true;
+        strcpy(pd.path_save_data_file, path_save_data_file);
+        save_puzzle_data(&pd, sd.current_difficulty, grid_puzzle, grid_solved);
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        load_or_create_puzzle(&pd, &sd, difficulty_values, grid_puzzle, grid_solved);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        elapsed = time_taken(begin, end);
+        load_total += elapsed;
+        load_worst  = (elapsed > load_worst) ? elapsed : load_worst;
+    }
+    remove(path_save_data_file);
+    fclose(output);
+    fclose(input);
+
+    printf("start %-6s  %6d runs   avg %8.3f us  max %8.3f us\n", "frame", BENCH_STARTUPS,
+           startup_total / BENCH_STARTUPS * 1e6, startup_worst * 1e6);
+    printf("start %-6s  %6d runs   avg %8.3f us  max %8.3f us\n", "load", BENCH_STARTUPS,
+           load_total / BENCH_STARTUPS * 1e6, load_worst * 1e6);
+    printf("start %-6s  %6d runs   avg %8.3f us  max %8.3f us\n", "create", BENCH_STARTUPS,
+           create_total / BENCH_STARTUPS * 1e6, create_worst * 1e6);
+    if (startup_worst > STARTUP_BUDGET) {
+        fprintf(stderr, "WARNING: the first frame took up to %.3f us, over the %.0f us budget\n",
+                startup_worst * 1e6, STARTUP_BUDGET * 1e6);
+    }
+}
+
+// Walks generated puzzles hint by hint, the same way repeated '?' presses would
+void benchmark_hints(size_t difficulty_values[COUNT_DIFFICULTY])
+{
+    for (size_t d = 0; d < COUNT_DIFFICULTY; ++d) {
+        size_t calls = 0;
+        double total = 0.0;
+        double worst = 0.0;
+
+        for (size_t p = 0; p < BENCH_PUZZLES; ++p) {
+            size_t grid_puzzle[N][N] = {0};
+            size_t grid_solved[N][N] = {0};
+            create_puzzle(grid_puzzle, grid_solved, difficulty_values[d]);
+
+            Candidates cand;
+            Hint hint;
+            candidates_init(&cand, grid_puzzle);
+            for (;;) {
+                struct timespec begin, end;
+                clock_gettime(CLOCK_MONOTONIC, &begin);
+                bool found = find_hint(&cand, grid_puzzle, &hint);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+
+                double elapsed = time_taken(begin, end);
+                total += elapsed;
+                worst = (elapsed > worst) ? elapsed : worst;
+                ++calls;
+
+                if (!found) {
+                    break;
+                }
+                apply_hint(&cand, &hint);
+                if (hint.technique == HINT_NAKED_SINGLE || hint.technique == HINT_HIDDEN_SINGLE) {
+                    grid_puzzle[hint.row][hint.col] = hint.digit;
+                    candidates_place(&cand, hint.row, hint.col, hint.digit);
+                }
+            }
+        }
+
+        printf("hint  %-6s  %6zu calls  avg %8.3f us  max %8.3f us\n", bench_difficulty_name(d), calls, total / calls * 1e6, worst * 1e6);
+    }
+}
+
+// Opt-in with -record or -replay. Every key becomes a frame, timestamped when
+// the key arrives, once it is handled, once the grid is drawn and once the
+// terminal is updated. Replaying runs against a dummy terminal writing to
+// /dev/null. ncurses writes straight to the terminal's file descriptor, so
+// the bytes each frame writes are counted from /proc/self/io instead.
+#define PROFILE_MAX_FRAMES 4096
+#define PROFILE_SEED       1 // Recording and replaying play the same puzzles
+
+typedef enum {
+    PROFILE_OFF,
+    PROFILE_RECORD,
+    PROFILE_REPLAY,
+} Profile_Mode;
+
+typedef enum {
+    STAGE_INPUT,
+    STAGE_HANDLED,
+    STAGE_RENDERED,
+    STAGE_REFRESHED,
+    COUNT_STAGES
+} Profile_Stage;
+
+typedef struct {
+    int             key;
+    struct timespec stages[COUNT_STAGES];
+    bool            refreshed;
+    long            bytes;
+} Profile_Frame;
+
+typedef struct {
+    Profile_Mode  mode;
+    FILE          *script;   // Keys are read from here when replaying, written when recording
+    FILE          *terminal; // Dummy terminal when replaying
+    FILE          *input;    // Its keyboard, /dev/null, as keys come from the script
+    SCREEN        *screen;
+    int           io_stats;  // /proc/self/io, with every byte the process has written
+    long          terminal_offset;
+    size_t        frame_count;
+    Profile_Frame frames[PROFILE_MAX_FRAMES];
+} Profiler;
+
+Profiler profiler = {0};
+
+// Keys are stored one per line, by name if they are not printable
+const struct {
+    int        key;
+    const char *name;
+} key_names[] = {
+    {'\t',       "TAB"},
+    {'\n',       "ENTER"},
+    {KEY_UP,     "UP"},
+    {KEY_DOWN,   "DOWN"},
+    {KEY_LEFT,   "LEFT"},
+    {KEY_RIGHT,  "RIGHT"},
+};
+#define COUNT_KEY_NAMES (sizeof(key_names) / sizeof(key_names[0]))
+
+// Leaves the name empty for keys the game does not use
+void key_name(int key, char *buffer, size_t size)
+{
+    for (size_t i = 0; i < COUNT_KEY_NAMES; ++i) {
+        if (key_names[i].key == key) {
+            snprintf(buffer, size, "%s", key_names[i].name);
+            return;
+        }
+    }
+    if (key > ' ' && key < 127) {
+        snprintf(buffer, size, "%c", key);
+    } else {
+        snprintf(buffer, size, "%s", "");
+    }
+}
+
+// Returns 'Q' at the end of the script, so every replay quits cleanly.
+// Empty lines and lines starting with '#' are skipped.
+int read_key(FILE *f)
+{
+    char line[ONE_KB];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        for (size_t i = 0; i < COUNT_KEY_NAMES; ++i) {
+            if (strcmp(line, key_names[i].name) == 0) {
+                return key_names[i].key;
+            }
+        }
+        return line[0];
+    }
+    return 'Q';
+}
+
+int profile_start(Profile_Mode mode, const char *path_script)
+{
+    profiler.mode   = mode;
+    profiler.script = fopen(path_script, (mode == PROFILE_REPLAY) ? "r" : "w");
+    if (profiler.script == NULL) {
+        fprintf(stderr, "ERROR: could not open key script at %s\n", path_script);
+        return 1;
+    }
+    profiler.io_stats = open("/proc/self/io", O_RDONLY);
+    if (profiler.io_stats == -1) {
+        fprintf(stderr, "ERROR: could not open /proc/self/io to count the bytes written\n");
+        return 1;
+    }
+    if (mode == PROFILE_REPLAY) {
+        profiler.terminal = fopen("/dev/null", "w");
+        profiler.input    = fopen("/dev/null", "r");
+        if (profiler.terminal == NULL || profiler.input == NULL) {
+            fprintf(stderr, "ERROR: could not open files for the dummy terminal\n");
+            return 1;
+        }
+    }
+    srand(PROFILE_SEED);
+    return 0;
+}
+
+int next_key(void)
+{
+    if (profiler.mode == PROFILE_REPLAY) {
+        return read_key(profiler.script);
+    }
+    int key = getch();
+    if (profiler.mode == PROFILE_RECORD) {
+        char name[8];
+        key_name(key, name, sizeof(name));
+        if (name[0] != '\0') {
+            fprintf(profiler.script, "%s\n", name);
+        }
+    }
+    return key;
+}
+
+// Counts every write, but between a key and its refresh only the terminal
+// is written to
+long terminal_bytes_written(void)
+{
+    char stats[ONE_KB];
+    ssize_t size = pread(profiler.io_stats, stats, sizeof(stats) - 1, 0);
+    if (size <= 0) {
+        return 0;
+    }
+    stats[size] = '\0';
+    char *wchar = strstr(stats, "wchar:");
+    return (wchar != NULL) ? atol(wchar + strlen("wchar:")) : 0;
+}
+
+// STAGE_INPUT starts a new frame, the other stages finish the latest one
+void profile_mark(Profile_Stage stage, int key)
+{
+    if (profiler.mode == PROFILE_OFF) {
+        return;
+    }
+
+    if (stage == STAGE_INPUT) {
+        if (profiler.frame_count == PROFILE_MAX_FRAMES) {
+            return;
+        }
+        Profile_Frame *frame = &profiler.frames[profiler.frame_count++];
+        frame->key = key;
+        profiler.terminal_offset = terminal_bytes_written(); // Before the clock starts
+        clock_gettime(CLOCK_MONOTONIC, &frame->stages[STAGE_INPUT]);
+        return;
+    }
+
+    if (profiler.frame_count == 0 || profiler.frames[profiler.frame_count - 1].refreshed) {
+        return; // The first frame is drawn before any key
+    }
+    Profile_Frame *frame = &profiler.frames[profiler.frame_count - 1];
+    clock_gettime(CLOCK_MONOTONIC, &frame->stages[stage]);
+    if (stage == STAGE_REFRESHED) {
+        frame->refreshed = true;
+        frame->bytes     = terminal_bytes_written() - profiler.terminal_offset;
+    }
+}
+
+void profile_report(void)
+{
+    if (profiler.mode == PROFILE_OFF) {
+        return;
+    }
+
+    printf("%5s  %-5s  %10s  %10s  %10s  %10s  %6s\n", "frame", "key", "handle_us", "render_us", "refresh_us", "total_us", "bytes");
+
+    size_t frames = 0;
+    double total_sum = 0.0, total_worst = 0.0;
+    long   bytes_sum = 0,   bytes_worst = 0;
+    for (size_t i = 0; i < profiler.frame_count; ++i) {
+        Profile_Frame *frame = &profiler.frames[i];
+        if (!frame->refreshed) {
+            continue; // Quitting draws nothing
+        }
+
+        char key[8];
+        key_name(frame->key, key, sizeof(key));
+        if (key[0] == '\0') {
+            snprintf(key, sizeof(key), "%d", frame->key);
+        }
+
+        double handle  = time_taken(frame->stages[STAGE_INPUT],    frame->stages[STAGE_HANDLED]);
+        double render  = time_taken(frame->stages[STAGE_HANDLED],  frame->stages[STAGE_RENDERED]);
+        double refresh = time_taken(frame->stages[STAGE_RENDERED], frame->stages[STAGE_REFRESHED]);
+        double total   = time_taken(frame->stages[STAGE_INPUT],    frame->stages[STAGE_REFRESHED]);
+        printf("%5zu  %-5s  %10.3f  %10.3f  %10.3f  %10.3f  %6ld\n", i + 1, key,
+               handle * 1e6, render * 1e6, refresh * 1e6, total * 1e6, frame->bytes);
+
+        ++frames;
+        total_sum  += total;
+        total_worst = (total > total_worst) ? total : total_worst;
+        bytes_sum  += frame->bytes;
+        bytes_worst = (frame->bytes > bytes_worst) ? frame->bytes : bytes_worst;
+    }
+
+    if (frames > 0) {
+        printf("%zu frames  input to refresh: avg %.3f us  max %.3f us  bytes: avg %.1f  max %ld\n", frames,
+               total_sum / frames * 1e6, total_worst * 1e6, (double)bytes_sum / frames, bytes_worst);
+    }
+}
+
+// Called after endwin()
+void profile_stop(void)
+{
+    if (profiler.screen != NULL) {
+        delscreen(profiler.screen);
+    }
+    if (profiler.script != NULL) {
+        fclose(profiler.script);
+    }
+    if (profiler.terminal != NULL) {
+        fclose(profiler.terminal);
+    }
+    if (profiler.input != NULL) {
+        fclose(profiler.input);
+    }
+    if (profiler.mode != PROFILE_OFF) {
+        close(profiler.io_stats);
+    }
+}
+
 void print_usage(char *program_name)
 {
     printf("Usage: %s <option>\n", program_name);
     printf("Options:\n");
     printf("  -times:   Show best times in each difficulty category\n");
+    printf("  -bench:   Benchmark startup, puzzle generation, solving and hints\n");
+    printf("  -record <file>: Play while timing each frame, saving the keys to <file>\n");
+    printf("  -replay <file>: Replay the keys in <file> without a terminal, timing each frame\n");
     printf("  -version: Show version\n");
     printf("  -help:    Show this help message\n");
 }
 
-int cli_args(Score_Data *sd, char *flag, char *program_name)
+int cli_args(Score_Data *sd, size_t difficulty_values[COUNT_DIFFICULTY], char *flag, char *program_name)
 {
     if (strcmp(flag, "-times") == 0) {
+        grab_scores(sd);
         for (size_t i = 0; i < COUNT_DIFFICULTY; ++i) {
             switch (i) {
             case 0:
@@ -559,6 +1896,12 @@ int cli_args(Score_Data *sd, char *flag, char *program_name)
             }
         }
         return 0;
+    } else if (strcmp(flag, "-bench") == 0) {
+        printf("variant: %s\n", (sizeof(VARIANT_SUFFIX) > 1) ? VARIANT_SUFFIX + 1 : "classic");
+        benchmark_startup(difficulty_values);
+        benchmark_puzzles(difficulty_values);
+        benchmark_hints(difficulty_values);
+        return 0;
     } else if (strcmp(flag, "-version") == 0) {
         printf("%s (version %s)\n", program_name, VERSION);
         return 0;
@@ -584,57 +1927,51 @@ int main(int argc, char **argv)
         .current_difficulty = EASY,
         .current_score      = 0.0,
         .best_scores        = {0.000000},
+        .scores_loaded      = false,
         .hint_used          = false,
     };
-    if (setup_score_file(sd.path_score_file) == 0) {
-        sd.save_scores = true;
-    }
-    grab_scores(&sd);
 
     Save_Data pd = {
         .save_data      = false,
         .path_save_data_file = {0},
     };
-    if (setup_save_data_file(pd.path_save_data_file) == 0) {
-        pd.save_data = true;
-    }
+    setup_files(&sd, &pd);
 
     char *program_name = SHIFT(argv, argc);
     if (argc > 0) {
         char *flag = SHIFT(argv, argc);
-        int ret = cli_args(&sd, flag, program_name);
-        if (ret == 0) return 0;
+        if (strcmp(flag, "-record") == 0 || strcmp(flag, "-replay") == 0) {
+            if (argc == 0) {
+                print_usage(program_name);
+                return 1;
+            }
+            Profile_Mode mode = (strcmp(flag, "-record") == 0) ? PROFILE_RECORD : PROFILE_REPLAY;
+            if (profile_start(mode, SHIFT(argv, argc)) != 0) return 1;
+            // Profiled games neither continue nor overwrite the saved game and scores
+            pd.save_data   = false;
+            sd.save_scores = false;
+        } else {
+            int ret = cli_args(&sd, difficulty_values, flag, program_name);
+            if (ret == 0) return 0;
+        }
     }
 
     size_t grid_puzzle[N][N] = {0};
     size_t grid_solved[N][N] = {0};
-    create_puzzle(grid_puzzle, grid_solved, difficulty_values[sd.current_difficulty]);
-    if (pd.save_data) {
-        load_last_puzzle(&pd, &sd.current_difficulty, grid_puzzle, grid_solved);
-        sd.save_scores = false;
-    }
+    Candidates cand;
+    Undo_History history = {0};
 
-    const char *INIT_TEXT    = "Press the <ENTER> key to start...";
     const char *INVALID_MOVE = "Invalid move";
     const int  len_init_text = strlen(INIT_TEXT);
 
     /* ----------------------  */
 
-    initscr();
-    noecho();
-    keypad(stdscr, TRUE);
-    cbreak();
-    curs_set(0);
-
-    if ((LINES < (int)GRID_Y) || (LINES <= (int)((LINES + GRID_Y) / 2) + 1)  || (COLS < (int)GRID_X)) {
-        endwin();
-        fprintf(stderr, "Terminal size too smol ._.\n");
-        fprintf(stderr, "Need minimum: 24 LINES, 39 COLUMNS\n"); // $ echo $LINES $COLUMNS
+    WINDOW *sudoku_matrix = start_first_frame(profiler.terminal, profiler.input, &profiler.screen);
+    if (sudoku_matrix == NULL) {
+        profile_stop();
         return 1;
     }
 
-    WINDOW *sudoku_matrix = newwin(GRID_Y, GRID_X, (LINES - GRID_Y) / 2, (COLS - GRID_X) / 2);
-
     Window_Info winfo = {
         .window               = sudoku_matrix,
         .puzzle_started       = false,
@@ -643,17 +1980,21 @@ int main(int argc, char **argv)
         .highlight_same_value = true,
         .number_completed     = false,
         .puzzle_completed     = false,
+        .notes_mode           = false,
+        .show_hint            = false,
     };
 
-    mvwprintw(stdscr, ((LINES + GRID_Y) / 2) + 1, (COLS - len_init_text) * 0.5, "%s", INIT_TEXT);
-    show_controls();
+    // The puzzle is only needed once <ENTER> is pressed, so it is loaded or
+    // made after the first frame is on screen
+    load_or_create_puzzle(&pd, &sd, difficulty_values, grid_puzzle, grid_solved);
+    candidates_init(&cand, grid_puzzle);
 
     size_t mistakes = 0;
     bool quit = false;
     size_t c;
 
     while (!winfo.puzzle_started && !quit) {
-        c = getch();
+        c = next_key();
         switch (c) {
         case '\n':
             winfo.puzzle_started = true;
@@ -670,10 +2011,15 @@ int main(int argc, char **argv)
     }
 
     while (!quit) {
-        draw_grid(&winfo, grid_puzzle, &sd);
+        draw_grid(&winfo, grid_puzzle, &cand, &sd);
+        profile_mark(STAGE_RENDERED, 0);
+        refresh_frame(winfo.window);
+        profile_mark(STAGE_REFRESHED, 0);
 
-        c = getch();
+        c = next_key();
+        profile_mark(STAGE_INPUT, c);
         clear_info_text(len_init_text);
+        winfo.show_hint = false;
 
         switch (c) {
         case KEY_UP:
@@ -711,8 +2057,17 @@ int main(int argc, char **argv)
         case '9': {
             if (!winfo.number_completed && grid_puzzle[winfo.cursor_row][winfo.cursor_col] == 0) {
                 size_t user_input = c - '0';
-                if (grid_solved[winfo.cursor_row][winfo.cursor_col] == user_input) {
+                if (winfo.notes_mode) {
+                    // Only digits still possible in this cell can be noted
+                    if (candidates_at(&cand, grid_puzzle, winfo.cursor_row, winfo.cursor_col) & DIGIT_BIT(user_input)) {
+                        cand.notes[winfo.cursor_row][winfo.cursor_col] ^= DIGIT_BIT(user_input);
+                        push_move(&history, MOVE_NOTE, winfo.cursor_row, winfo.cursor_col, user_input);
+                    }
+                }
+                else if (grid_solved[winfo.cursor_row][winfo.cursor_col] == user_input) {
                     grid_puzzle[winfo.cursor_row][winfo.cursor_col] = user_input;
+                    candidates_place(&cand, winfo.cursor_row, winfo.cursor_col, user_input);
+                    push_move(&history, MOVE_PLACE, winfo.cursor_row, winfo.cursor_col, user_input);
                 }
                 else {
                     mvwprintw(stdscr, ((LINES + GRID_Y) / 2) + 1, (COLS - strlen(INVALID_MOVE)) * 0.5, "%s: %zu", INVALID_MOVE, user_input);
@@ -727,6 +2082,8 @@ int main(int argc, char **argv)
 
             memset(grid_puzzle, 0, sizeof(grid_puzzle)); // reset puzzle
             create_puzzle(grid_puzzle, grid_solved, difficulty_values[sd.current_difficulty]);
+            candidates_init(&cand, grid_puzzle);
+            history.count = 0;
 
             winfo.number_completed = false;
             winfo.puzzle_completed = false;
@@ -736,11 +2093,28 @@ int main(int argc, char **argv)
             size_t ret = clock_gettime(CLOCK_MONOTONIC, &time_begin);
             assert(ret == 0);
             break;
-        case '?':
-            if (grid_puzzle[winfo.cursor_row][winfo.cursor_col] == 0) {
-                grid_puzzle[winfo.cursor_row][winfo.cursor_col] = grid_solved[winfo.cursor_row][winfo.cursor_col];
+        case '?': { // show the next logical step
+            char hint_text[ONE_KB];
+            winfo.show_hint = find_hint(&cand, grid_puzzle, &winfo.hint);
+            describe_hint(&winfo.hint, hint_text, sizeof(hint_text));
+            if (winfo.show_hint) {
+                apply_hint(&cand, &winfo.hint);
+                if (winfo.hint.technique == HINT_NAKED_SINGLE || winfo.hint.technique == HINT_HIDDEN_SINGLE) {
+                    winfo.cursor_row = winfo.hint.row;
+                    winfo.cursor_col = winfo.hint.col;
+                }
                 sd.hint_used = true;
             }
+            mvwprintw(stdscr, ((LINES + GRID_Y) / 2) + 1, (COLS - strlen(hint_text)) * 0.5, "%s", hint_text);
+            break;
+        }
+        case 'N': // (toggle) notes mode
+            winfo.notes_mode = !winfo.notes_mode;
+            break;
+        case 'U': // undo last placement or note
+            if (!winfo.puzzle_completed) {
+                undo_move(&history, &cand, grid_puzzle);
+            }
             break;
         case 'H': // (toggle) highlight same value cells
             winfo.highlight_same_value = !winfo.highlight_same_value;
@@ -758,10 +2132,13 @@ int main(int argc, char **argv)
         default:
             break;
         }
+        profile_mark(STAGE_HANDLED, c);
     }
 
     delwin(sudoku_matrix);
     endwin();
+    profile_report();
+    profile_stop();
 
     double elapsed_time = time_taken(time_begin, time_end);
     if (elapsed_time != 0.0) {